@@ -3,7 +3,9 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <cstring>
+#include <cstdio>
 #include <vector>
 #include <array>
 #include <algorithm>
@@ -12,14 +14,40 @@
 #include <deque>
 #include <unordered_set>
 #include <bits/unordered_set.h>
+#include <unordered_map>
 #include <map>
+#include <limits>
+#include <set>
 #include <chrono>
 #include <random>
+#include <numeric>
+#include <atomic>
+#include <thread>
 
 //region GLOBAL VARIABLES
 
 bool DebugMode;
 
+bool ShortenPaths;
+
+static const std::chrono::milliseconds ShortenBudget(50);
+
+static const int ShortenWindow = 8;
+
+static const int ShortenRequiredDiamonds = 12;
+
+static const int ShortenDeadlineCheck = 256;
+
+int BeamWidth;
+
+static const int BeamLookahead = 2;
+
+static const size_t ParallelLevelSize = 1024;
+
+static const size_t ExportBufferSize = 1 << 20;
+
+static const int UnreachedLevel = std::numeric_limits<int>::max();
+
 //endregion
 
 //region STATS
@@ -38,31 +66,57 @@ public:
     unsigned long long int iterations = 0;
     unsigned long long int gu_leap_limit = 0;
     unsigned long long int gu_no_path = 0;
+    unsigned long long int gu_dominated = 0;
 
 private:
-    static bool exists(const std::string &filename) {
+    static bool readHeader(const std::string &filename, std::string &header) {
         std::ifstream ifile(filename);
-        return ifile.is_open();
+        if (!ifile.is_open()) return false;
+        std::getline(ifile, header);
+        return true;
+    }
+
+    static std::string freeBackupName(const std::string &filename) {
+        std::string backup = filename + ".old";
+        for (int suffix = 1; std::ifstream(backup).is_open(); ++suffix) {
+            backup = filename + ".old." + std::to_string(suffix);
+        }
+        return backup;
     }
 
 public:
     void save(const std::string &filename) {
         char sep = ',';
-        bool needs_header_init = !exists(filename);
+        std::ostringstream header;
+        header << "case_name" << sep << "height" << sep << "width" << sep << "max_leaps" << sep << "diamonds"
+               << sep << "non_empty_nodes" << sep << "edges" << sep << "edges_visited" << sep
+               << "diamonds_gathered" << sep << "iterations" << sep << "gu_leap_limit" << sep << "gu_no_path"
+               << sep << "gu_dominated";
+
+        // A log written with other columns is moved aside instead of getting rows it cannot describe,
+        // to a name no earlier log uses yet.
+        std::string existing_header;
+        bool needs_header_init = !readHeader(filename, existing_header);
+        if (!needs_header_init && existing_header != header.str()) {
+            std::string backup = freeBackupName(filename);
+            if (std::rename(filename.c_str(), backup.c_str()) != 0) {
+                std::cerr << "Unable to move old log file to " << backup << std::endl;
+                std::cerr << strerror(errno) << std::endl;
+                return;
+            }
+            needs_header_init = true;
+        }
 
         std::ofstream log_file;
         log_file.open(filename, std::ios_base::out | std::ios_base::app);
         if (log_file.is_open()) {
             if (needs_header_init)
-                log_file << "case_name" << sep << "height" << sep << "width" << sep << "max_leaps" << sep << "diamonds"
-                         << sep << "non_empty_nodes" << sep << "edges" << sep << "edges_visited" << sep
-                         << "diamonds_gathered" << sep << "iterations" << sep << "gu_leap_limit" << sep << "gu_no_path"
-                         << std::endl;
+                log_file << header.str() << std::endl;
 
             log_file << case_name << sep << height << sep << width << sep << max_leaps << sep << diamonds
                      << sep << non_empty_nodes << sep << edges << sep << edges_visited << sep
                      << diamonds_gathered << sep << iterations << sep << gu_leap_limit << sep << gu_no_path
-                     << std::endl;
+                     << sep << gu_dominated << std::endl;
             log_file.close();
         } else {
             std::cerr << "Unable to open log file" << std::endl;
@@ -126,10 +180,28 @@ class Edge;
 
 class Vertex;
 
+struct FrontierEntry;
+
 class Graph;
 
+class SlideTable;
+
 struct MoveData;
 
+struct ReplayResult;
+
+class BigCount;
+
+struct CountState;
+
+class SolutionCounter;
+
+class SolutionEnumerator;
+
+struct BeamResult;
+
+class BeamSearch;
+
 //endregion
 
 //region DATA STRUCTURES
@@ -157,9 +229,14 @@ struct MoveData {
 
 class Map {
 private:
-    char **map; // TODO: Linearise this array
+    static const std::array<char, 6> Symbols;
+
+    std::vector<unsigned char> cells; // Two 4-bit cells per byte, row after row
 
-    Map(int height, int width, int maxMoves, char **map, Position shipPosition, int allDiamonds);
+    Map(int height, int width, int maxMoves, std::vector<unsigned char> &&cells, Position shipPosition,
+        int allDiamonds);
+
+    static void Store(std::vector<unsigned char> &cells, size_t index, char c);
 
     void set(Position position, Entity e);
 
@@ -169,7 +246,7 @@ public:
     int const height;
     int const width;
     int const maxMoves;
-    int const allDiamonds;
+    int allDiamonds;
     const Position initialPosition;
 
     ~Map();
@@ -178,6 +255,10 @@ public:
 
     const char at(Position position);
 
+    bool contains(Position position) const;
+
+    void edit(Position position, Entity e);
+
     void print();
 
     MoveData move(Position initial, Direction direction);
@@ -236,15 +317,63 @@ namespace std {
 class Vertex {
 public:
     std::map<Direction, Edge *> edges{};
+    std::vector<Edge *> inEdges{};
     int outDeg;
     int inDeg;
+    int level; // BFS distance from the ship
+
+    Vertex() : outDeg(0), inDeg(0), level(UnreachedLevel) {}
+};
 
-    Vertex() : outDeg(0), inDeg(0) {}
+struct FrontierEntry {
+    std::vector<unsigned long long int> mask;
+    int diamonds;
+    int leaps;
 };
 
 class Graph {
 private:
     Map *map;
+    std::unordered_map<Position, int> diamondIndices;
+    std::unordered_map<Position, std::vector<FrontierEntry>> frontiers;
+    std::unordered_map<Position, int> diamondCoverage;
+    size_t coveredDiamonds = 0;
+    std::vector<Direction> cachedSolution;
+    bool hasCachedSolution = false;
+
+    void indexDiamond(Position diax);
+
+    void coverDiamonds(Edge *e, int delta);
+
+    void attachEdge(Vertex *vertex, Edge *e);
+
+    void detachEdge(Vertex *vertex, Edge *e);
+
+    void expand(std::queue<Position> &positions, std::vector<Edge *> &added, std::vector<Position> &created);
+
+    void expandLevels(Position start);
+
+    void relink(Position position, Direction direction, std::queue<Position> &positions,
+                std::vector<Position> &weakened, std::vector<Edge *> &added);
+
+    void refreshCell(Position position);
+
+    void dropLeftovers();
+
+    void updateReachability(const std::vector<Position> &weakened, const std::vector<Edge *> &added,
+                            const std::vector<Position> &created);
+
+    std::vector<Edge *> *replayCachedSolution(int maxLeaps);
+
+    bool isDominated(Position v, std::unordered_set<Position> *diamondsGathered, int leaps);
+
+    bool removeIdleCycle(std::vector<Edge *> &path);
+
+    bool rerouteSegment(std::vector<Edge *> &path, std::chrono::steady_clock::time_point deadline);
+
+    std::vector<Edge *> *boundedRoute(Position from, const Position *to, const std::vector<Position> &required,
+                                      int maxLeaps, std::chrono::steady_clock::time_point deadline);
+
 public:
     std::unordered_set<Position> diamonds{};
     std::map<Position, Vertex *> vertices;
@@ -255,7 +384,7 @@ public:
 
     ~Graph();
 
-    void print();
+    void print(std::ostream &stream = std::cout);
 
     void printVisitedMap(std::ostream &stream = std::cout);
 
@@ -265,18 +394,166 @@ public:
 
     void printDotPath(std::vector<Edge *> *edges, std::ostream &stream = std::cout);
 
+    void printJsonLines(std::ostream &stream, std::vector<Edge *> *edges = nullptr);
+
+    void saveJsonLines(const std::string &filePath, std::vector<Edge *> *edges = nullptr);
+
     std::vector<Edge *>
     *traversalSub(Position v, std::vector<Edge *> *edgesVisited, std::unordered_set<Position> *diamondsGathered,
                   int maxDiamonds, int maxLeaps);
 
+    std::vector<Edge *> *search(int maxLeaps);
+
     void traversal(int maxLeaps);
+
+    void applyEdit(Position position, Entity e);
+
+    void shortenPath(std::vector<Edge *> &path, std::chrono::milliseconds budget);
+};
+
+struct ReplayResult {
+    bool valid;
+    int leaps;
+    int diamondsGathered;
+    const char *reason;
+};
+
+class SlideTable {
+private:
+    std::vector<unsigned int> diamondStamps;
+    unsigned int generation;
+
+public:
+    static const int NoSlide = -1;
+
+    int start;
+    int maxLeaps;
+    std::vector<Position> positions;
+    std::map<Position, int> indices;
+    std::vector<Position> diamonds;
+    std::vector<int> targets;
+    std::vector<int> diamondOffsets;
+    std::vector<int> diamondIds;
+
+    SlideTable(Map *map, Graph *graph);
+
+    int target(int vertex, int direction) const;
+
+    ReplayResult replay(const char *stringPath);
+};
+
+class BigCount {
+private:
+    std::vector<unsigned int> limbs;
+
+public:
+    BigCount(unsigned long long int value = 0);
+
+    BigCount &operator+=(const BigCount &rhs);
+
+    bool isZero() const;
+
+    std::string toString() const;
+};
+
+struct CountState {
+    int vertex;
+    int remaining;
+    unsigned long long int mask;
+
+    bool operator==(const CountState &rhs) const;
+};
+
+namespace std {
+    template<>
+    struct hash<CountState> {
+        size_t operator()(const CountState &s) const {
+            return hash<unsigned long long int>()(s.mask) ^ (hash<int>()(s.vertex * 1024 + s.remaining) << 1);
+        }
+    };
+}
+
+class SolutionCounter {
+private:
+    std::unordered_map<CountState, BigCount> memo;
+
+public:
+    SlideTable *table;
+    unsigned long long int allDiamonds;
+    std::vector<unsigned long long int> slideMasks;
+
+    explicit SolutionCounter(SlideTable *table);
+
+    const BigCount &count(int vertex, unsigned long long int mask, int remaining);
+
+    BigCount count();
+};
+
+class SolutionEnumerator {
+private:
+    struct Frame {
+        int vertex;
+        unsigned long long int mask;
+        int remaining;
+        int direction;
+    };
+
+    SolutionCounter *counter;
+    std::vector<Frame> frames;
+    std::string path;
+
+public:
+    explicit SolutionEnumerator(SolutionCounter *counter);
+
+    bool next(std::string &solution);
+};
+
+struct BeamResult {
+    std::string path;
+    int diamondsGathered;
+    int allDiamonds;
+};
+
+class BeamSearch {
+private:
+    struct Candidate {
+        int parent;
+        int slide;
+        int vertex;
+        int gathered;
+        int distance;
+        unsigned long long int key;
+    };
+
+    SlideTable *table;
+    int width;
+    int words;
+    std::vector<unsigned long long int> zobrist;
+    std::vector<int> frontier;
+    std::vector<int> nextFrontier;
+    std::vector<int> predecessorOffsets;
+    std::vector<int> predecessors;
+    std::vector<int> coverOffsets;
+    std::vector<int> covers;
+    std::vector<int> distances;
+
+    bool gathered(int diamond, const unsigned long long int *mask, int slide) const;
+
+    void measureDistances(const unsigned long long int *mask);
+
+    int distanceToRemaining(int vertex, const unsigned long long int *mask, int slide);
+
+public:
+    BeamSearch(SlideTable *table, int width);
+
+    BeamResult run();
 };
 
 //endregion
 
 //region FUNCTIONS DECLARATION
 
-Map *ReadMapFromFile(char *filename) {
+Map *ReadMapFromFile(const char *filename) {
     std::ifstream inputFile;
 
     inputFile.open(filename);
@@ -297,8 +574,22 @@ Map *ReadMapFromStdin();
 
 void CheckPath(Map *map, char *pathName);
 
+void PrintReplayResult(const ReplayResult &result, std::ostream &stream = std::cout);
+
+bool ValidateCorpus(const char *corpusName);
+
+void CountSolutions(Map *map, unsigned long long int limit);
+
+unsigned long long int ParseNumber(const char *text);
+
 void PrintPathNumbers(std::vector<Edge *> &edges, std::ostream &stream = std::cout);
 
+bool OpenExportFile(std::ofstream &file, std::vector<char> &buffer, const std::string &filePath);
+
+void BeamSolve(Map *map, Graph *graph);
+
+void EditAndSolve(Map *map, const char *editsName);
+
 void Solve(Map *map);
 
 //endregion
@@ -371,12 +662,24 @@ bool Position::operator<(const Position &rhs) const {
 
 //region MAP IMPLEMENTATION
 
+const std::array<char, 6> Map::Symbols = {VOID, WALL, HOLE, MINE, DIAX, SHIP};
+
+void Map::Store(std::vector<unsigned char> &cells, size_t index, char c) {
+    auto symbol = std::find(Symbols.begin(), Symbols.end(), c);
+    if (symbol == Symbols.end()) {
+        throw "Unknown entity";
+    }
+
+    auto code = (unsigned char) (symbol - Symbols.begin());
+    unsigned char &cell = cells[index / 2];
+    cell = (index % 2 == 0) ? (unsigned char) ((cell & 0xF0) | code) : (unsigned char) ((cell & 0x0F) | (code << 4));
+}
+
 Map *Map::CreateFromInputStream(std::istream &stream) {
     int height, width, maxMoves;
-    char **map;
 
     stream >> height >> width >> maxMoves;
-    map = new char *[height];
+    std::vector<unsigned char> cells(((size_t) height * width + 1) / 2, 0);
 
     Position shipPosition = Position(-1, -1);
     int targetScore = 0;
@@ -385,15 +688,16 @@ Map *Map::CreateFromInputStream(std::istream &stream) {
     std::string line;
     stream >> std::noskipws;
     for (int i = height - 1; i >= 0; --i) {
-        map[i] = new char[width];
         for (int j = 0; j < width; ++j) {
-            stream >> map[i][j];
-            if (map[i][j] == DIAX) {
+            char c = VOID;
+            stream >> c;
+            if (c == DIAX) {
                 targetScore++;
-            } else if (map[i][j] == SHIP) {
-                map[i][j] = HOLE;
+            } else if (c == SHIP) {
+                c = HOLE;
                 shipPosition = Position(j, i);
             }
+            Store(cells, (size_t) i * width + j, c);
         }
         stream.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
     }
@@ -402,7 +706,7 @@ Map *Map::CreateFromInputStream(std::istream &stream) {
         throw "Ship not found";
     }
 
-    return new Map(height, width, maxMoves, map, shipPosition, targetScore);
+    return new Map(height, width, maxMoves, std::move(cells), shipPosition, targetScore);
 }
 
 void Map::save(const std::string &filePath) {
@@ -434,7 +738,7 @@ std::unordered_set<Position> *Map::getDiamonds() {
     for (int i = 0; i < height; ++i) {
         for (int j = 0; j < width; ++j) {
             if (at(j, i) == DIAX) {
-                diamonds->insert(Position(i, j));
+                diamonds->insert(Position(j, i));
             }
         }
     }
@@ -504,11 +808,39 @@ const char Map::at(int x, int y) {
         throw "Index out of bounds";
     }
 
-    return map[y][x];
+    size_t index = (size_t) y * width + x;
+    unsigned char cell = cells[index / 2];
+    return Symbols[(index % 2 == 0) ? (cell & 0x0F) : (cell >> 4)];
+}
+
+bool Map::contains(Position position) const {
+    return position.x >= 0 && position.y >= 0 && position.x < width && position.y < height;
+}
+
+void Map::edit(Position position, Entity e) {
+    if (!contains(position)) {
+        throw "Index out of bounds";
+    }
+    if (position == initialPosition) {
+        throw "Cannot edit the ship position";
+    }
+    if (e == SHIP) {
+        throw "Cannot place another ship";
+    }
+    bool border = position.x == 0 || position.y == 0 || position.x == width - 1 || position.y == height - 1;
+    if (border && e != WALL && e != MINE) {
+        throw "Border cells must stop every slide";
+    }
+
+    char previous = at(position);
+    set(position, e);
+    if (previous == DIAX) allDiamonds--;
+    if (e == DIAX) allDiamonds++;
 }
 
-Map::Map(int height, int width, int maxMoves, char **map, Position shipPosition, int allDiamonds)
-        : height(height), width(width), maxMoves(maxMoves), map(map), initialPosition(shipPosition),
+Map::Map(int height, int width, int maxMoves, std::vector<unsigned char> &&cells, Position shipPosition,
+         int allDiamonds)
+        : height(height), width(width), maxMoves(maxMoves), cells(std::move(cells)), initialPosition(shipPosition),
           allDiamonds(allDiamonds) {
 }
 
@@ -521,42 +853,92 @@ void Map::set(int x, int y, Entity e) {
         throw "Index out of bounds";
     }
 
-    map[y][x] = e;
+    Store(cells, (size_t) y * width + x, e);
 }
 
-Map::~Map() {
-    for (int i = 0; i < height; ++i) {
-        delete[] map[i];
-    }
-    delete[] map;
-}
+Map::~Map() = default;
 
 //endregion
 
 //region GRAPH IMPLEMENTATION
 
-void Graph::traversal(int maxLeaps) {
+std::vector<Edge *> *Graph::search(int maxLeaps) {
+    if (hasCachedSolution) {
+        auto cached = replayCachedSolution(maxLeaps);
+        if (cached != nullptr) return cached;
+    }
+
+    // Diamonds that no reachable slide passes over make the search hopeless, which is the common
+    // case right after an edit walls something off.
+    if (coveredDiamonds < diamonds.size()) {
+        hasCachedSolution = false;
+        return new std::vector<Edge *>();
+    }
+
+    frontiers.clear();
     auto result = traversalSub(map->initialPosition, new std::vector<Edge *>(),
                                new std::unordered_set<Position>(),
                                diamonds.size(), maxLeaps);
+
+    hasCachedSolution = !result->empty();
+    cachedSolution.clear();
+    for (Edge *e : *result) {
+        cachedSolution.push_back((Direction) e->direction);
+    }
+    return result;
+}
+
+std::vector<Edge *> *Graph::replayCachedSolution(int maxLeaps) {
+    // Same rules as traversalSub: a map without diamonds has no solution and a path ends at the
+    // leap that gathers the last diamond.
+    if (diamonds.empty()) return nullptr;
+
+    auto path = new std::vector<Edge *>();
+    std::unordered_set<Position> diamondsGathered;
+    Position current = map->initialPosition;
+    for (Direction d : cachedSolution) {
+        auto ekv = vertices.at(current)->edges.find(d);
+        if (ekv == vertices.at(current)->edges.end()) {
+            delete path;
+            return nullptr;
+        }
+        path->push_back(ekv->second);
+        diamondsGathered.insert(ekv->second->diamonds->begin(), ekv->second->diamonds->end());
+        current = ekv->second->to;
+        if (diamondsGathered.size() == diamonds.size()) {
+            if (path->size() <= maxLeaps) return path;
+            break;
+        }
+    }
+
+    delete path;
+    return nullptr;
+}
+
+void Graph::traversal(int maxLeaps) {
+    auto result = search(maxLeaps);
     if (result->empty()) {
         std::cout << ("BRAK");
         delete result;
     } else {
+        if (ShortenPaths) {
+            shortenPath(*result, ShortenBudget);
+        }
         PrintPathNumbers(*result);
         if (DebugMode) {
             std::cout << std::endl;
             this->printDotPath(result);
 
+            std::vector<char> output_dot_buffer;
             std::ofstream output_dot_file;
-            output_dot_file.open("sol.dot");
-            if (output_dot_file.is_open()) {
+            if (OpenExportFile(output_dot_file, output_dot_buffer, "sol.dot")) {
                 this->printDotPath(result, output_dot_file);
                 output_dot_file.close();
             } else {
                 std::cerr << "Unable to open dot output file" << std::endl;
                 std::cerr << strerror(errno) << std::endl;
             }
+            this->saveJsonLines("sol.jsonl", result);
 
             std::ofstream output_path_file;
             output_path_file.open("sol.txt");
@@ -597,6 +979,15 @@ Graph::traversalSub(Position v, std::vector<Edge *> *edgesVisited, std::unordere
         return new std::vector<Edge *>();
     }
 
+    if (isDominated(v, diamondsGathered, edgesVisited->size())) {
+        if (DebugMode) {
+            Stats.gu_dominated++;
+        }
+        delete edgesVisited;
+        delete diamondsGathered;
+        return new std::vector<Edge *>();
+    }
+
     for (auto kv : vertices.at(v)->edges) {
 //        if (std::all_of(edgesVisited->begin(), edgesVisited->end(),
 //                        [e = kv.second](Edge *x) { return *x != *e; })) {
@@ -630,33 +1021,186 @@ Graph::traversalSub(Position v, std::vector<Edge *> *edgesVisited, std::unordere
     return new std::vector<Edge *>();
 }
 
+bool Graph::isDominated(Position v, std::unordered_set<Position> *diamondsGathered, int leaps) {
+    FrontierEntry entry = {std::vector<unsigned long long int>((diamondIndices.size() + 63) / 64, 0),
+                           (int) diamondsGathered->size(), leaps};
+    for (Position diax : *diamondsGathered) {
+        int i = diamondIndices.at(diax);
+        entry.mask[i / 64] |= 1ULL << (i % 64);
+    }
+
+    // A state reached earlier at v with a superset of diamonds and no more leaps used either failed
+    // already or is still being explored above us, so this one cannot lead anywhere new.
+    std::vector<FrontierEntry> &frontier = frontiers[v];
+    for (const FrontierEntry &other : frontier) {
+        if (other.diamonds < entry.diamonds || other.leaps > leaps) continue;
+        bool subset = true;
+        for (size_t w = 0; w < entry.mask.size() && subset; ++w) {
+            subset = (entry.mask[w] & ~other.mask[w]) == 0;
+        }
+        if (subset) return true;
+    }
+
+    frontier.erase(std::remove_if(frontier.begin(), frontier.end(), [&entry](const FrontierEntry &other) {
+        if (other.diamonds > entry.diamonds || other.leaps < entry.leaps) return false;
+        for (size_t w = 0; w < entry.mask.size(); ++w) {
+            if ((other.mask[w] & ~entry.mask[w]) != 0) return false;
+        }
+        return true;
+    }), frontier.end());
+    frontier.push_back(entry);
+    return false;
+}
+
+void Graph::shortenPath(std::vector<Edge *> &path, std::chrono::milliseconds budget) {
+    auto deadline = std::chrono::steady_clock::now() + budget;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (!removeIdleCycle(path) && !rerouteSegment(path, deadline)) break;
+    }
+}
+
+bool Graph::removeIdleCycle(std::vector<Edge *> &path) {
+    std::map<Position, int> gathered;
+    for (Edge *e : path) {
+        for (Position diax : *(e->diamonds)) {
+            gathered[diax]++;
+        }
+    }
+
+    // A segment can go if it starts and ends at the same vertex (or runs to the end of the path)
+    // and every diamond it gathers is gathered again outside of it.
+    for (int i = 0; i < path.size(); ++i) {
+        std::map<Position, int> segment;
+        int critical = 0;
+        int best = -1;
+        for (int j = i; j < path.size(); ++j) {
+            for (Position diax : *(path[j]->diamonds)) {
+                if (++segment[diax] == gathered[diax]) critical++;
+            }
+            if (critical > 0) break;
+            if (path[j]->to == path[i]->from || j == path.size() - 1) best = j;
+        }
+        if (best >= 0) {
+            path.erase(path.begin() + i, path.begin() + best + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Graph::rerouteSegment(std::vector<Edge *> &path, std::chrono::steady_clock::time_point deadline) {
+    std::map<Position, int> gathered;
+    for (Edge *e : path) {
+        for (Position diax : *(e->diamonds)) {
+            gathered[diax]++;
+        }
+    }
+
+    for (int length = std::min<int>(ShortenWindow, path.size()); length >= 2; --length) {
+        for (int i = 0; i + length <= path.size(); ++i) {
+            if (std::chrono::steady_clock::now() >= deadline) return false;
+
+            std::map<Position, int> segment;
+            for (int j = i; j < i + length; ++j) {
+                for (Position diax : *(path[j]->diamonds)) {
+                    segment[diax]++;
+                }
+            }
+            std::vector<Position> required;
+            for (const auto &dkv : segment) {
+                if (dkv.second == gathered[dkv.first]) required.push_back(dkv.first);
+            }
+            if (required.size() > ShortenRequiredDiamonds) continue;
+
+            bool tail = i + length == path.size();
+            auto route = boundedRoute(path[i]->from, tail ? nullptr : &path[i + length - 1]->to, required,
+                                      length - 1, deadline);
+            if (route != nullptr) {
+                path.erase(path.begin() + i, path.begin() + i + length);
+                path.insert(path.begin() + i, route->begin(), route->end());
+                delete route;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+std::vector<Edge *> *
+Graph::boundedRoute(Position from, const Position *to, const std::vector<Position> &required, int maxLeaps,
+                    std::chrono::steady_clock::time_point deadline) {
+    struct RouteNode {
+        Position position;
+        unsigned int mask;
+        int parent;
+        Edge *edge;
+        int depth;
+    };
+
+    std::map<Position, int> requiredIndices;
+    for (int i = 0; i < required.size(); ++i) {
+        requiredIndices.insert(std::pair<Position, int>(required[i], i));
+    }
+    unsigned int allRequired = (1u << required.size()) - 1;
+
+    std::vector<RouteNode> nodes;
+    std::set<std::pair<Position, unsigned int>> seen;
+    nodes.push_back({from, 0, -1, nullptr, 0});
+    seen.insert(std::make_pair(from, 0u));
+    for (int n = 0; n < nodes.size(); ++n) {
+        if (n % ShortenDeadlineCheck == 0 && std::chrono::steady_clock::now() >= deadline) return nullptr;
+
+        RouteNode node = nodes[n];
+        if (node.mask == allRequired && (to == nullptr || node.position == *to)) {
+            auto route = new std::vector<Edge *>(node.depth);
+            for (int k = n; nodes[k].parent >= 0; k = nodes[k].parent) {
+                (*route)[nodes[k].depth - 1] = nodes[k].edge;
+            }
+            return route;
+        }
+        if (node.depth == maxLeaps) continue;
+
+        for (auto ekv : vertices.at(node.position)->edges) {
+            unsigned int mask = node.mask;
+            for (Position diax : *(ekv.second->diamonds)) {
+                auto rkv = requiredIndices.find(diax);
+                if (rkv != requiredIndices.end()) mask |= 1u << rkv->second;
+            }
+            if (seen.insert(std::make_pair(ekv.second->to, mask)).second) {
+                nodes.push_back({ekv.second->to, mask, n, ekv.second, node.depth + 1});
+            }
+        }
+    }
+    return nullptr;
+}
+
 void Graph::printDotPath(std::vector<Edge *> *edges, std::ostream &stream) {
-    stream << "digraph diaminy {" << std::endl;
-    stream << "\trankdir=TOP" << std::endl;
-    stream << "\tnode [style=filled, shape=circle, color=lightgreen];" << std::endl;
-    for (auto vkv : vertices) {
-        Position position = vkv.first;
-        for (auto ekv: vkv.second->edges) {
-            bool is_path = std::any_of(edges->begin(), edges->end(),
-                                       [e = ekv.second](Edge *x) { return *x == *e; });
-            stream << "\t\"(" << position.x << "," << position.y << ")\" -> \"("
-                   << ekv.second->to.x << "," << ekv.second->to.y << ")\" [label=" << ekv.second->diamonds->size()
-                   << (is_path ? ", style=bold, color=tomato" : "") << "];" << std::endl;
-        }
-    }
-    for (Edge *e : *edges) {
-        stream << "\t\"(" << e->to.x << "," << e->to.y << ")\" [color=lightskyblue]" << std::endl;
-    }
-    stream << "\t\"(" << map->initialPosition.x << "," << map->initialPosition.y << ")\" [color=gold]"
-           << std::endl;
+    std::unordered_set<const Edge *> onPath(edges->begin(), edges->end());
+
+    stream << "digraph diaminy {\n";
+    stream << "\trankdir=TOP\n";
+    stream << "\tnode [style=filled, shape=circle, color=lightgreen];\n";
+    for (const auto &vkv : vertices) {
+        const Position &position = vkv.first;
+        for (const auto &ekv: vkv.second->edges) {
+            const Edge *e = ekv.second;
+            stream << "\t\"(" << position.x << "," << position.y << ")\" -> \"(" << e->to.x << "," << e->to.y
+                   << ")\" [label=" << e->diamonds->size()
+                   << (onPath.count(e) != 0 ? ", style=bold, color=tomato" : "") << "];\n";
+        }
+    }
+    for (const Edge *e : *edges) {
+        stream << "\t\"(" << e->to.x << "," << e->to.y << ")\" [color=lightskyblue]\n";
+    }
+    stream << "\t\"(" << map->initialPosition.x << "," << map->initialPosition.y << ")\" [color=gold]\n";
     stream << "}" << std::endl;
 }
 
 void Graph::save(const std::string &filePath) {
+    std::vector<char> buffer;
     std::ofstream output_file;
 
-    output_file.open(filePath);
-    if (output_file.is_open()) {
+    if (OpenExportFile(output_file, buffer, filePath)) {
         printDot(output_file);
         output_file.close();
     } else {
@@ -666,19 +1210,53 @@ void Graph::save(const std::string &filePath) {
 }
 
 void Graph::printDot(std::ostream &stream) {
-    stream << "digraph diaminy {" << std::endl;
-    stream << "\trankdir=TOP" << std::endl;
-    stream << "\tnode [style=filled, shape=circle, color=lightgreen];" << std::endl;
-    for (auto vkv : vertices) {
-        Position position = vkv.first;
-        for (auto ekv: vkv.second->edges) {
-            stream << "\t\"(" << position.x << "," << position.y << ")\" -> \"(" << ekv.second->to.x << ","
-                   << ekv.second->to.y << ")\" [label=" << ekv.second->diamonds->size() << "];" << std::endl;
-        }
-    }
-    stream << "\t\"(" << map->initialPosition.x << "," << map->initialPosition.y << ")\" [color=gold]"
-           << std::endl;
-    stream << "}" << std::endl;
+    std::vector<Edge *> noPath;
+    printDotPath(&noPath, stream);
+}
+
+void Graph::printJsonLines(std::ostream &stream, std::vector<Edge *> *edges) {
+    std::unordered_set<const Edge *> onPath;
+    if (edges != nullptr) onPath.insert(edges->begin(), edges->end());
+
+    stream << "{\"type\":\"graph\",\"height\":" << map->height << ",\"width\":" << map->width
+           << ",\"max_leaps\":" << map->maxMoves << ",\"start\":[" << map->initialPosition.x << ","
+           << map->initialPosition.y << "],\"diamonds\":" << diamonds.size() << ",\"vertices\":"
+           << vertices.size() << "}\n";
+    for (const auto &vkv : vertices) {
+        const Position &position = vkv.first;
+        stream << "{\"type\":\"vertex\",\"at\":[" << position.x << "," << position.y << "],\"in\":"
+               << vkv.second->inDeg << ",\"out\":" << vkv.second->outDeg << "}\n";
+        for (const auto &ekv : vkv.second->edges) {
+            const Edge *e = ekv.second;
+            stream << "{\"type\":\"edge\",\"from\":[" << position.x << "," << position.y << "],\"to\":["
+                   << e->to.x << "," << e->to.y << "],\"direction\":" << e->direction << ",\"diamonds\":[";
+            bool first = true;
+            for (const Position &diax : *(e->diamonds)) {
+                stream << (first ? "[" : ",[") << diax.x << "," << diax.y << "]";
+                first = false;
+            }
+            stream << "],\"path\":" << (onPath.count(e) != 0 ? "true" : "false") << "}\n";
+        }
+    }
+    if (edges != nullptr) {
+        stream << "{\"type\":\"path\",\"directions\":\"";
+        PrintPathNumbers(*edges, stream);
+        stream << "\"}\n";
+    }
+    stream.flush();
+}
+
+void Graph::saveJsonLines(const std::string &filePath, std::vector<Edge *> *edges) {
+    std::vector<char> buffer;
+    std::ofstream output_file;
+
+    if (OpenExportFile(output_file, buffer, filePath)) {
+        printJsonLines(output_file, edges);
+        output_file.close();
+    } else {
+        std::cerr << "Unable to open file" << std::endl;
+        std::cerr << strerror(errno) << std::endl;
+    }
 }
 
 void Graph::printVisitedMap(std::ostream &stream) {
@@ -695,16 +1273,17 @@ void Graph::printVisitedMap(std::ostream &stream) {
     }
 }
 
-void Graph::print() {
-    for (auto vkv : vertices) {
-        Position position = vkv.first;
-        printf("(%d,%d): ", position.x, position.y);
-        for (auto ekv : vkv.second->edges) {
-            printf("{(%d,%d), %d, %d} ", ekv.second->to.x, ekv.second->to.y, ekv.second->diamonds->size(),
-                   ekv.second->direction);
+void Graph::print(std::ostream &stream) {
+    for (const auto &vkv : vertices) {
+        const Position &position = vkv.first;
+        stream << "(" << position.x << "," << position.y << "): ";
+        for (const auto &ekv : vkv.second->edges) {
+            stream << "{(" << ekv.second->to.x << "," << ekv.second->to.y << "), " << ekv.second->diamonds->size()
+                   << ", " << ekv.second->direction << "} ";
         }
-        printf("\n");
+        stream << '\n';
     }
+    stream.flush();
 }
 
 Graph::Graph(Map *map) {
@@ -713,41 +1292,772 @@ Graph::Graph(Map *map) {
     std::unordered_set<Position> *dia;
     dia = map->getDiamonds();
     diamonds.insert(dia->begin(), dia->end());
+    delete dia;
+    for (Position diax : diamonds) {
+        indexDiamond(diax);
+    }
 
-    std::queue<Position> positions;
-    positions.push(map->initialPosition);
     vertices.insert(std::pair<Position, Vertex *>(map->initialPosition, new Vertex()));
-    while (!positions.empty()) {
-        Position currentPosition = positions.front();
-        positions.pop();
+    expandLevels(map->initialPosition);
+}
 
-        Vertex *&currentVertex = vertices.at(currentPosition);
-        if (currentVertex == nullptr) {
-            throw "Some vertex was not initialized!";
-        }
-        for (int d = 0; d < 8; ++d) {
-            MoveData md = map->move(currentPosition, d);
-            if (md.finalPosition != currentPosition) {
-                Edge *e = new Edge(md.diamondsGathered, d, currentPosition, md.finalPosition);
-                currentVertex->edges.insert(std::pair<Direction, Edge *>((Direction) d, e));
-                currentVertex->outDeg++;
-
-                if (vertices.count(md.finalPosition) == 0) {
-                    vertices.insert(std::pair<Position, Vertex *>(md.finalPosition, new Vertex()));
-                    positions.push(md.finalPosition);
+void Graph::expandLevels(Position start) {
+    unsigned int workers = std::max(1u, std::thread::hardware_concurrency());
+    size_t cellCount = (size_t) map->height * map->width;
+    std::vector<std::atomic<unsigned long long int>> visited((cellCount + 63) / 64);
+    std::atomic<const char *> error(nullptr);
+
+    auto claim = [&](Position p) {
+        size_t index = (size_t) p.y * map->width + p.x;
+        unsigned long long int bit = 1ULL << (index % 64);
+        return (visited[index / 64].fetch_or(bit) & bit) == 0;
+    };
+    claim(start);
+
+    // Level-synchronous BFS: every worker slides its share of the current level and claims new
+    // endpoints in the shared visited bitmap, the level's discoveries are merged into vertices
+    // afterwards.
+    std::vector<std::pair<Position, Vertex *>> level(1, std::make_pair(start, vertices.at(start)));
+    vertices.at(start)->level = 0;
+    for (int depth = 1; !level.empty(); ++depth) {
+        unsigned int levelWorkers = level.size() < ParallelLevelSize ? 1 : workers;
+        std::vector<std::vector<std::pair<Position, Vertex *>>> discovered(levelWorkers);
+
+        auto work = [&](unsigned int worker) {
+            try {
+                for (size_t i = worker; i < level.size(); i += levelWorkers) {
+                    Position currentPosition = level[i].first;
+                    Vertex *currentVertex = level[i].second;
+                    for (int d = 0; d < 8; ++d) {
+                        MoveData md = map->move(currentPosition, d);
+                        if (md.finalPosition == currentPosition) {
+                            delete md.diamondsGathered;
+                            continue;
+                        }
+
+                        Edge *e = new Edge(md.diamondsGathered, d, currentPosition, md.finalPosition);
+                        currentVertex->edges.insert(std::pair<Direction, Edge *>((Direction) d, e));
+                        currentVertex->outDeg++;
+                        if (claim(md.finalPosition)) {
+                            discovered[worker].push_back(std::make_pair(md.finalPosition, new Vertex()));
+                        }
+                    }
                 }
-                vertices.at(md.finalPosition)->inDeg++;
+            } catch (const char *e) {
+                error = e;
+            }
+        };
+
+        if (levelWorkers == 1) {
+            work(0);
+        } else {
+            std::vector<std::thread> threads;
+            for (unsigned int worker = 0; worker < levelWorkers; ++worker) {
+                threads.emplace_back(work, worker);
+            }
+            for (std::thread &thread : threads) {
+                thread.join();
             }
         }
-    }
-}
 
-Graph::~Graph() {
-    for (const auto &kv : vertices) {
-        for (auto ekv : kv.second->edges) {
-            delete ekv.second;
+        std::vector<std::pair<Position, Vertex *>> next;
+        for (const auto &found : discovered) {
+            for (const auto &vkv : found) {
+                vkv.second->level = depth;
+                vertices.insert(vkv);
+                next.push_back(vkv);
+            }
+        }
+        if (error != nullptr) {
+            throw error.load();
+        }
+        level.swap(next);
+    }
+
+    for (const auto &vkv : vertices) {
+        for (auto ekv : vkv.second->edges) {
+            Vertex *target = vertices.at(ekv.second->to);
+            target->inEdges.push_back(ekv.second);
+            target->inDeg++;
+            coverDiamonds(ekv.second, 1);
+        }
+    }
+}
+
+void Graph::indexDiamond(Position diax) {
+    // Indices are never reused, so a diamond that comes back after an edit keeps its old bit.
+    if (diamondIndices.count(diax) == 0) {
+        diamondIndices.insert(std::pair<Position, int>(diax, diamondIndices.size()));
+    }
+}
+
+void Graph::coverDiamonds(Edge *e, int delta) {
+    for (Position diax : *(e->diamonds)) {
+        int &coverage = diamondCoverage[diax];
+        bool wasCovered = coverage > 0;
+        coverage += delta;
+        if (wasCovered != (coverage > 0) && diamonds.count(diax) != 0) {
+            coveredDiamonds += delta;
+        }
+        if (coverage == 0) diamondCoverage.erase(diax);
+    }
+}
+
+void Graph::attachEdge(Vertex *vertex, Edge *e) {
+    vertex->edges.insert(std::pair<Direction, Edge *>((Direction) e->direction, e));
+    vertex->outDeg++;
+
+    Vertex *target = vertices.at(e->to);
+    target->inEdges.push_back(e);
+    target->inDeg++;
+    coverDiamonds(e, 1);
+}
+
+void Graph::detachEdge(Vertex *vertex, Edge *e) {
+    vertex->edges.erase((Direction) e->direction);
+    vertex->outDeg--;
+
+    Vertex *target = vertices.at(e->to);
+    auto in = std::find(target->inEdges.begin(), target->inEdges.end(), e);
+    *in = target->inEdges.back();
+    target->inEdges.pop_back();
+    target->inDeg--;
+    coverDiamonds(e, -1);
+    delete e;
+}
+
+void Graph::expand(std::queue<Position> &positions, std::vector<Edge *> &added, std::vector<Position> &created) {
+    while (!positions.empty()) {
+        Position currentPosition = positions.front();
+        positions.pop();
+
+        Vertex *&currentVertex = vertices.at(currentPosition);
+        if (currentVertex == nullptr) {
+            throw "Some vertex was not initialized!";
+        }
+        for (int d = 0; d < 8; ++d) {
+            MoveData md = map->move(currentPosition, d);
+            if (md.finalPosition == currentPosition) {
+                delete md.diamondsGathered;
+                continue;
+            }
+
+            if (vertices.count(md.finalPosition) == 0) {
+                vertices.insert(std::pair<Position, Vertex *>(md.finalPosition, new Vertex()));
+                positions.push(md.finalPosition);
+                created.push_back(md.finalPosition);
+            }
+            Edge *e = new Edge(md.diamondsGathered, d, currentPosition, md.finalPosition);
+            attachEdge(currentVertex, e);
+            added.push_back(e);
+        }
+    }
+}
+
+void Graph::applyEdit(Position position, Entity e) {
+    auto previous = (Entity) map->at(position);
+    map->edit(position, e);
+    try {
+        refreshCell(position);
+    } catch (const char *error) {
+        // Drop what the failed update created, re-sliding the same lines over the old cell then puts
+        // back the slides we had.
+        map->edit(position, previous);
+        dropLeftovers();
+        refreshCell(position);
+        throw error;
+    }
+}
+
+void Graph::dropLeftovers() {
+    // Every vertex that was already in the graph has a level, only the ones a failed update created
+    // are still unreached.
+    std::vector<Position> leftovers;
+    for (const auto &vkv : vertices) {
+        if (vkv.second->level == UnreachedLevel) leftovers.push_back(vkv.first);
+    }
+    for (Position p : leftovers) {
+        Vertex *vertex = vertices.at(p);
+        while (!vertex->inEdges.empty()) {
+            Edge *e = vertex->inEdges.back();
+            detachEdge(vertices.at(e->from), e);
+        }
+        while (!vertex->edges.empty()) {
+            detachEdge(vertex, vertex->edges.begin()->second);
+        }
+    }
+    for (Position p : leftovers) {
+        delete vertices.at(p);
+        vertices.erase(p);
+    }
+}
+
+void Graph::refreshCell(Position position) {
+    if (map->at(position) == DIAX && diamonds.insert(position).second) {
+        indexDiamond(position);
+        if (diamondCoverage.count(position) != 0) coveredDiamonds++;
+    } else if (map->at(position) != DIAX && diamonds.erase(position) != 0) {
+        if (diamondCoverage.count(position) != 0) coveredDiamonds--;
+    }
+
+    // Only slides whose line runs through the edited cell can change, so walk its 8 lines
+    // backwards and re-slide every vertex found on them towards the cell.
+    std::vector<std::pair<Position, Direction>> affected;
+    for (int d = 0; d < 8; ++d) {
+        Direction towardsCell = (Direction) d;
+        Direction awayFromCell = (Direction) ((d + 4) % 8);
+        for (Position p = position.move(awayFromCell); map->contains(p); p = p.move(awayFromCell)) {
+            if (vertices.count(p) != 0) {
+                affected.emplace_back(p, towardsCell);
+            }
+        }
+        if (vertices.count(position) != 0) {
+            affected.emplace_back(position, towardsCell);
+        }
+    }
+
+    std::queue<Position> positions;
+    std::vector<Position> weakened;
+    std::vector<Edge *> added;
+    for (const auto &slide : affected) {
+        relink(slide.first, slide.second, positions, weakened, added);
+    }
+
+    std::vector<Position> created;
+    for (std::queue<Position> pending = positions; !pending.empty(); pending.pop()) {
+        created.push_back(pending.front());
+    }
+    expand(positions, added, created);
+    updateReachability(weakened, added, created);
+}
+
+void Graph::relink(Position position, Direction direction, std::queue<Position> &positions,
+                   std::vector<Position> &weakened, std::vector<Edge *> &added) {
+    Vertex *vertex = vertices.at(position);
+    auto ekv = vertex->edges.find(direction);
+    if (ekv != vertex->edges.end()) {
+        weakened.push_back(ekv->second->to);
+        detachEdge(vertex, ekv->second);
+    }
+
+    MoveData md = map->move(position, direction);
+    if (md.finalPosition == position) {
+        delete md.diamondsGathered;
+        return;
+    }
+
+    if (vertices.count(md.finalPosition) == 0) {
+        vertices.insert(std::pair<Position, Vertex *>(md.finalPosition, new Vertex()));
+        positions.push(md.finalPosition);
+    }
+    Edge *e = new Edge(md.diamondsGathered, direction, position, md.finalPosition);
+    attachEdge(vertex, e);
+    added.push_back(e);
+}
+
+void Graph::updateReachability(const std::vector<Position> &weakened, const std::vector<Edge *> &added,
+                               const std::vector<Position> &created) {
+    typedef std::pair<int, Position> LevelEntry;
+    auto later = [](const LevelEntry &a, const LevelEntry &b) { return a.first > b.first; };
+
+    // First find the vertices that lost every in-edge coming from one level closer to the ship.
+    // Going through the candidates level by level means their parents have been settled before.
+    std::priority_queue<LevelEntry, std::vector<LevelEntry>, decltype(later)> candidates(later);
+    for (Position p : weakened) {
+        auto vkv = vertices.find(p);
+        if (vkv != vertices.end() && vkv->second->level != UnreachedLevel && p != map->initialPosition) {
+            candidates.push(std::make_pair(vkv->second->level, p));
+        }
+    }
+
+    std::unordered_set<Position> affected;
+    while (!candidates.empty()) {
+        LevelEntry entry = candidates.top();
+        candidates.pop();
+        Vertex *vertex = vertices.at(entry.second);
+        if (affected.count(entry.second) != 0 || vertex->level != entry.first) continue;
+
+        bool supported = std::any_of(vertex->inEdges.begin(), vertex->inEdges.end(), [&](Edge *e) {
+            return vertices.at(e->from)->level == entry.first - 1 && affected.count(e->from) == 0;
+        });
+        if (supported) continue;
+
+        affected.insert(entry.second);
+        for (auto ekv : vertex->edges) {
+            if (vertices.at(ekv.second->to)->level == entry.first + 1) {
+                candidates.push(std::make_pair(entry.first + 1, ekv.second->to));
+            }
         }
     }
+
+    // Then settle new levels outwards from the untouched part of the graph and the new edges.
+    std::priority_queue<LevelEntry, std::vector<LevelEntry>, decltype(later)> frontier(later);
+    for (Position p : affected) {
+        vertices.at(p)->level = UnreachedLevel;
+    }
+    for (Position p : affected) {
+        for (Edge *e : vertices.at(p)->inEdges) {
+            int level = vertices.at(e->from)->level;
+            if (level != UnreachedLevel) frontier.push(std::make_pair(level + 1, p));
+        }
+    }
+    for (Edge *e : added) {
+        int level = vertices.at(e->from)->level;
+        if (level != UnreachedLevel && level + 1 < vertices.at(e->to)->level) {
+            frontier.push(std::make_pair(level + 1, e->to));
+        }
+    }
+    while (!frontier.empty()) {
+        LevelEntry entry = frontier.top();
+        frontier.pop();
+        Vertex *vertex = vertices.at(entry.second);
+        if (entry.first >= vertex->level) continue;
+
+        vertex->level = entry.first;
+        for (auto ekv : vertex->edges) {
+            if (entry.first + 1 < vertices.at(ekv.second->to)->level) {
+                frontier.push(std::make_pair(entry.first + 1, ekv.second->to));
+            }
+        }
+    }
+
+    // Whatever is still unreached can only be reached from other unreached vertices, so unhook
+    // all of their slides before dropping them.
+    std::vector<Position> unreached;
+    for (Position p : affected) {
+        if (vertices.at(p)->level == UnreachedLevel) unreached.push_back(p);
+    }
+    for (Position p : created) {
+        if (vertices.at(p)->level == UnreachedLevel && affected.count(p) == 0) unreached.push_back(p);
+    }
+    for (Position p : unreached) {
+        Vertex *vertex = vertices.at(p);
+        while (!vertex->edges.empty()) {
+            detachEdge(vertex, vertex->edges.begin()->second);
+        }
+    }
+    for (Position p : unreached) {
+        delete vertices.at(p);
+        vertices.erase(p);
+    }
+}
+
+Graph::~Graph() {
+    for (const auto &kv : vertices) {
+        for (auto ekv : kv.second->edges) {
+            delete ekv.second;
+        }
+    }
+}
+
+//endregion
+
+//region SLIDE TABLE IMPLEMENTATION
+
+const int SlideTable::NoSlide;
+
+SlideTable::SlideTable(Map *map, Graph *graph) : generation(0), maxLeaps(map->maxMoves) {
+    for (const auto &vkv : graph->vertices) {
+        indices.insert(std::pair<Position, int>(vkv.first, positions.size()));
+        positions.push_back(vkv.first);
+    }
+
+    std::map<Position, int> diamondIndices;
+    for (Position diax : graph->diamonds) {
+        diamondIndices.insert(std::pair<Position, int>(diax, 0));
+    }
+    for (auto &dkv : diamondIndices) {
+        dkv.second = diamonds.size();
+        diamonds.push_back(dkv.first);
+    }
+
+    targets.assign(positions.size() * 8, NoSlide);
+    diamondOffsets.assign(positions.size() * 8 + 1, 0);
+    for (int v = 0; v < positions.size(); ++v) {
+        Vertex *vertex = graph->vertices.at(positions[v]);
+        for (int d = 0; d < 8; ++d) {
+            diamondOffsets[v * 8 + d] = diamondIds.size();
+            auto ekv = vertex->edges.find((Direction) d);
+            if (ekv == vertex->edges.end()) continue;
+
+            targets[v * 8 + d] = indices.at(ekv->second->to);
+            for (Position diax : *(ekv->second->diamonds)) {
+                diamondIds.push_back(diamondIndices.at(diax));
+            }
+        }
+    }
+    diamondOffsets[positions.size() * 8] = diamondIds.size();
+
+    start = indices.at(map->initialPosition);
+    diamondStamps.assign(diamonds.size(), 0);
+}
+
+int SlideTable::target(int vertex, int direction) const {
+    return targets[vertex * 8 + direction];
+}
+
+ReplayResult SlideTable::replay(const char *stringPath) {
+    if (++generation == 0) {
+        std::fill(diamondStamps.begin(), diamondStamps.end(), 0);
+        generation = 1;
+    }
+
+    ReplayResult result = {false, 0, 0, nullptr};
+    int v = start;
+    for (int i = 0; stringPath[i] != '\0'; ++i) {
+        if (stringPath[i] < '0' || stringPath[i] > '7') {
+            result.reason = "Wrong path";
+            return result;
+        }
+        int slide = v * 8 + (stringPath[i] - '0');
+        if (targets[slide] == NoSlide) {
+            result.reason = "Illegal move";
+            return result;
+        }
+        if (++result.leaps > maxLeaps) {
+            result.reason = "Too much leaps";
+            return result;
+        }
+        for (int j = diamondOffsets[slide]; j < diamondOffsets[slide + 1]; ++j) {
+            if (diamondStamps[diamondIds[j]] != generation) {
+                diamondStamps[diamondIds[j]] = generation;
+                result.diamondsGathered++;
+            }
+        }
+        v = targets[slide];
+    }
+
+    if (result.diamondsGathered < diamonds.size()) {
+        result.reason = "Not all diamonds gathered";
+        return result;
+    }
+
+    result.valid = true;
+    return result;
+}
+
+//endregion
+
+//region SOLUTION COUNTING IMPLEMENTATION
+
+BigCount::BigCount(unsigned long long int value) {
+    while (value != 0) {
+        limbs.push_back((unsigned int) value);
+        value >>= 32;
+    }
+}
+
+BigCount &BigCount::operator+=(const BigCount &rhs) {
+    if (limbs.size() < rhs.limbs.size()) {
+        limbs.resize(rhs.limbs.size(), 0);
+    }
+    unsigned long long int carry = 0;
+    for (size_t i = 0; i < limbs.size(); ++i) {
+        carry += (unsigned long long int) limbs[i] + (i < rhs.limbs.size() ? rhs.limbs[i] : 0);
+        limbs[i] = (unsigned int) carry;
+        carry >>= 32;
+        if (carry == 0 && i >= rhs.limbs.size()) break;
+    }
+    if (carry != 0) {
+        limbs.push_back((unsigned int) carry);
+    }
+    return *this;
+}
+
+bool BigCount::isZero() const {
+    return limbs.empty();
+}
+
+std::string BigCount::toString() const {
+    if (isZero()) return "0";
+
+    std::vector<unsigned int> quotient(limbs);
+    std::vector<unsigned int> chunks;
+    while (!quotient.empty()) {
+        unsigned long long int remainder = 0;
+        for (size_t i = quotient.size(); i-- > 0;) {
+            unsigned long long int current = (remainder << 32) | quotient[i];
+            quotient[i] = (unsigned int) (current / 1000000000);
+            remainder = current % 1000000000;
+        }
+        chunks.push_back((unsigned int) remainder);
+        while (!quotient.empty() && quotient.back() == 0) quotient.pop_back();
+    }
+
+    std::string result = std::to_string(chunks.back());
+    for (size_t i = chunks.size() - 1; i-- > 0;) {
+        std::string chunk = std::to_string(chunks[i]);
+        result += std::string(9 - chunk.size(), '0') + chunk;
+    }
+    return result;
+}
+
+bool CountState::operator==(const CountState &rhs) const {
+    return vertex == rhs.vertex &&
+           remaining == rhs.remaining &&
+           mask == rhs.mask;
+}
+
+SolutionCounter::SolutionCounter(SlideTable *table) : table(table) {
+    if (table->diamonds.size() > 64) {
+        throw "Too much diamonds to count solutions";
+    }
+
+    allDiamonds = table->diamonds.size() == 64 ? ~0ULL : (1ULL << table->diamonds.size()) - 1;
+    slideMasks.assign(table->targets.size(), 0);
+    for (size_t slide = 0; slide < slideMasks.size(); ++slide) {
+        for (int j = table->diamondOffsets[slide]; j < table->diamondOffsets[slide + 1]; ++j) {
+            slideMasks[slide] |= 1ULL << table->diamondIds[j];
+        }
+    }
+}
+
+const BigCount &SolutionCounter::count(int vertex, unsigned long long int mask, int remaining) {
+    static const BigCount zero(0), one(1);
+
+    if (mask == allDiamonds) return one;
+    if (remaining == 0) return zero;
+
+    CountState state = {vertex, remaining, mask};
+    auto mkv = memo.find(state);
+    if (mkv != memo.end()) return mkv->second;
+
+    BigCount total;
+    for (int d = 0; d < 8; ++d) {
+        int target = table->target(vertex, d);
+        if (target == SlideTable::NoSlide) continue;
+        total += count(target, mask | slideMasks[vertex * 8 + d], remaining - 1);
+    }
+
+    return memo.emplace(state, total).first->second;
+}
+
+BigCount SolutionCounter::count() {
+    // Like traversalSub, a map without diamonds has no solution rather than the empty one.
+    if (allDiamonds == 0) return BigCount(0);
+    return count(table->start, 0, table->maxLeaps);
+}
+
+SolutionEnumerator::SolutionEnumerator(SolutionCounter *counter) : counter(counter) {
+    if (counter->allDiamonds != 0) {
+        frames.push_back({counter->table->start, 0, counter->table->maxLeaps, 0});
+    }
+}
+
+bool SolutionEnumerator::next(std::string &solution) {
+    while (!frames.empty()) {
+        Frame &frame = frames.back();
+        if (frame.direction == 8 || frame.remaining == 0) {
+            frames.pop_back();
+            if (!path.empty()) path.pop_back();
+            continue;
+        }
+
+        int d = frame.direction++;
+        int target = counter->table->target(frame.vertex, d);
+        if (target == SlideTable::NoSlide) continue;
+
+        unsigned long long int mask = frame.mask | counter->slideMasks[frame.vertex * 8 + d];
+        int remaining = frame.remaining - 1;
+        if (counter->count(target, mask, remaining).isZero()) continue;
+
+        path.push_back((char) ('0' + d));
+        if (mask == counter->allDiamonds) {
+            solution = path;
+            path.pop_back();
+            return true;
+        }
+        frames.push_back({target, mask, remaining, 0});
+    }
+    return false;
+}
+
+//endregion
+
+//region BEAM SEARCH IMPLEMENTATION
+
+BeamSearch::BeamSearch(SlideTable *table, int width) : table(table), width(width) {
+    if (width <= 0) {
+        throw "Beam width must be positive";
+    }
+
+    words = std::max<int>(1, (table->diamonds.size() + 63) / 64);
+    std::mt19937_64 engine(0x9E3779B97F4A7C15ULL);
+    for (size_t i = 0; i < table->diamonds.size(); ++i) {
+        zobrist.push_back(engine());
+    }
+
+    // Reverse slides and, for every diamond, the vertices with a slide over it, both as flat
+    // offset/value arrays like the ones in the slide table.
+    int vertexCount = table->positions.size();
+    predecessorOffsets.assign(vertexCount + 1, 0);
+    coverOffsets.assign(table->diamonds.size() + 1, 0);
+    for (int slide = 0; slide < vertexCount * 8; ++slide) {
+        if (table->targets[slide] == SlideTable::NoSlide) continue;
+        predecessorOffsets[table->targets[slide] + 1]++;
+        for (int j = table->diamondOffsets[slide]; j < table->diamondOffsets[slide + 1]; ++j) {
+            coverOffsets[table->diamondIds[j] + 1]++;
+        }
+    }
+    std::partial_sum(predecessorOffsets.begin(), predecessorOffsets.end(), predecessorOffsets.begin());
+    std::partial_sum(coverOffsets.begin(), coverOffsets.end(), coverOffsets.begin());
+
+    std::vector<int> predecessorFill(predecessorOffsets.begin(), predecessorOffsets.end() - 1);
+    std::vector<int> coverFill(coverOffsets.begin(), coverOffsets.end() - 1);
+    predecessors.resize(predecessorOffsets.back());
+    covers.resize(coverOffsets.back());
+    for (int slide = 0; slide < vertexCount * 8; ++slide) {
+        if (table->targets[slide] == SlideTable::NoSlide) continue;
+        predecessors[predecessorFill[table->targets[slide]]++] = slide / 8;
+        for (int j = table->diamondOffsets[slide]; j < table->diamondOffsets[slide + 1]; ++j) {
+            covers[coverFill[table->diamondIds[j]]++] = slide / 8;
+        }
+    }
+}
+
+bool BeamSearch::gathered(int diamond, const unsigned long long int *mask, int slide) const {
+    if (mask[diamond / 64] & (1ULL << (diamond % 64))) return true;
+    for (int j = table->diamondOffsets[slide]; j < table->diamondOffsets[slide + 1]; ++j) {
+        if (table->diamondIds[j] == diamond) return true;
+    }
+    return false;
+}
+
+void BeamSearch::measureDistances(const unsigned long long int *mask) {
+    // Leaps from every vertex to the nearest slide over a diamond missing from the mask, found with
+    // one BFS over the reverse slides. A vertex with such a slide of its own is one leap away.
+    distances.assign(table->positions.size(), UnreachedLevel);
+    frontier.clear();
+    for (int diamond = 0; diamond < table->diamonds.size(); ++diamond) {
+        if (mask[diamond / 64] & (1ULL << (diamond % 64))) continue;
+        for (int j = coverOffsets[diamond]; j < coverOffsets[diamond + 1]; ++j) {
+            if (distances[covers[j]] == UnreachedLevel) {
+                distances[covers[j]] = 1;
+                frontier.push_back(covers[j]);
+            }
+        }
+    }
+    for (size_t i = 0; i < frontier.size(); ++i) {
+        int v = frontier[i];
+        for (int j = predecessorOffsets[v]; j < predecessorOffsets[v + 1]; ++j) {
+            if (distances[predecessors[j]] == UnreachedLevel) {
+                distances[predecessors[j]] = distances[v] + 1;
+                frontier.push_back(predecessors[j]);
+            }
+        }
+    }
+}
+
+int BeamSearch::distanceToRemaining(int vertex, const unsigned long long int *mask, int slide) {
+    frontier.assign(1, vertex);
+    for (int depth = 1; depth <= BeamLookahead; ++depth) {
+        nextFrontier.clear();
+        for (int v : frontier) {
+            for (int d = 0; d < 8; ++d) {
+                int target = table->target(v, d);
+                if (target == SlideTable::NoSlide) continue;
+                int s = v * 8 + d;
+                for (int j = table->diamondOffsets[s]; j < table->diamondOffsets[s + 1]; ++j) {
+                    if (!gathered(table->diamondIds[j], mask, slide)) return depth;
+                }
+                nextFrontier.push_back(target);
+            }
+        }
+        frontier.swap(nextFrontier);
+    }
+    // Past the lookahead fall back to the distances measured for the whole layer.
+    return std::max(BeamLookahead + 1, distances[vertex]);
+}
+
+BeamResult BeamSearch::run() {
+    int allDiamonds = table->diamonds.size();
+
+    std::vector<int> layerVertices(1, table->start), layerGathered(1, 0);
+    std::vector<unsigned long long int> layerKeys(1, 0), layerMasks(words, 0);
+    std::vector<std::vector<std::pair<int, char>>> trace;
+    std::vector<Candidate> candidates;
+    std::unordered_set<unsigned long long int> seen;
+    std::vector<unsigned long long int> measuredUnion;
+    int bestDepth = 0, bestIndex = 0, bestGathered = 0;
+
+    for (int depth = 0; depth < table->maxLeaps && bestGathered < allDiamonds; ++depth) {
+        candidates.clear();
+        seen.clear();
+        // Measure the distances towards the diamonds no state of the layer has gathered yet, those
+        // are missing from every mask so the distance never leads a state back to its own diamonds.
+        std::vector<unsigned long long int> layerUnion(words, 0);
+        for (int i = 0; i < layerVertices.size(); ++i) {
+            for (int w = 0; w < words; ++w) layerUnion[w] |= layerMasks[i * words + w];
+        }
+        if (depth == 0 || layerUnion != measuredUnion) {
+            measureDistances(layerUnion.data());
+            measuredUnion.swap(layerUnion);
+        }
+        for (int i = 0; i < layerVertices.size(); ++i) {
+            const unsigned long long int *mask = &layerMasks[i * words];
+            for (int d = 0; d < 8; ++d) {
+                int target = table->target(layerVertices[i], d);
+                if (target == SlideTable::NoSlide) continue;
+
+                int slide = layerVertices[i] * 8 + d;
+                Candidate candidate = {i, slide, target, layerGathered[i], 0, layerKeys[i]};
+                for (int j = table->diamondOffsets[slide]; j < table->diamondOffsets[slide + 1]; ++j) {
+                    int diamond = table->diamondIds[j];
+                    if (!(mask[diamond / 64] & (1ULL << (diamond % 64)))) {
+                        candidate.gathered++;
+                        candidate.key ^= zobrist[diamond];
+                    }
+                }
+                // Zobrist keys stand in for the full mask, collisions are negligible at 64 bits.
+                if (!seen.insert(candidate.key * 0x100000001B3ULL + target).second) continue;
+
+                candidate.distance = candidate.gathered == allDiamonds ? 0 : distanceToRemaining(target, mask, slide);
+                candidates.push_back(candidate);
+            }
+        }
+        if (candidates.empty()) break;
+
+        if (candidates.size() > width) {
+            std::nth_element(candidates.begin(), candidates.begin() + width, candidates.end(),
+                             [](const Candidate &a, const Candidate &b) {
+                                 if (a.gathered != b.gathered) return a.gathered > b.gathered;
+                                 return a.distance < b.distance;
+                             });
+            candidates.resize(width);
+        }
+
+        std::vector<unsigned long long int> masks(candidates.size() * words);
+        trace.emplace_back();
+        layerVertices.resize(candidates.size());
+        layerGathered.resize(candidates.size());
+        layerKeys.resize(candidates.size());
+        for (int i = 0; i < candidates.size(); ++i) {
+            const Candidate &candidate = candidates[i];
+            unsigned long long int *mask = &masks[i * words];
+            std::copy(layerMasks.begin() + candidate.parent * words,
+                      layerMasks.begin() + (candidate.parent + 1) * words, mask);
+            for (int j = table->diamondOffsets[candidate.slide]; j < table->diamondOffsets[candidate.slide + 1]; ++j) {
+                mask[table->diamondIds[j] / 64] |= 1ULL << (table->diamondIds[j] % 64);
+            }
+            trace.back().push_back(std::make_pair(candidate.parent, (char) ('0' + candidate.slide % 8)));
+            layerVertices[i] = candidate.vertex;
+            layerGathered[i] = candidate.gathered;
+            layerKeys[i] = candidate.key;
+            if (candidate.gathered > bestGathered) {
+                bestGathered = candidate.gathered;
+                bestDepth = depth + 1;
+                bestIndex = i;
+            }
+        }
+        layerMasks.swap(masks);
+    }
+
+    BeamResult result = {std::string(bestDepth, ' '), bestGathered, allDiamonds};
+    for (int depth = bestDepth, index = bestIndex; depth > 0; --depth) {
+        result.path[depth - 1] = trace[depth - 1][index].second;
+        index = trace[depth - 1][index].first;
+    }
+    return result;
 }
 
 //endregion
@@ -760,7 +2070,24 @@ void PrintPathNumbers(std::vector<Edge *> &edges, std::ostream &stream) {
     }
 }
 
+bool OpenExportFile(std::ofstream &file, std::vector<char> &buffer, const std::string &filePath) {
+    // The stream flushes into the buffer when it is destroyed, so callers declare the buffer first.
+    buffer.resize(ExportBufferSize);
+    file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file.open(filePath);
+    return file.is_open();
+}
+
 void CheckPath(Map *map, char *pathName) {
+    // Replay over the slide table first, it rejects bad paths with a reason where traverse would throw.
+    auto graph = new Graph(map);
+    SlideTable table(map, graph);
+    ReplayResult result = table.replay(pathName);
+    PrintReplayResult(result);
+    std::cout << std::endl;
+    delete graph;
+    if (!result.valid) return;
+
     auto path = map->traverse(pathName);
     std::ofstream outputPathFile;
     outputPathFile.open("path.txt");
@@ -776,11 +2103,181 @@ void CheckPath(Map *map, char *pathName) {
     delete path;
 }
 
+void PrintReplayResult(const ReplayResult &result, std::ostream &stream) {
+    stream << (result.valid ? "PASS" : "FAIL") << " leaps=" << result.leaps
+           << " diamonds=" << result.diamondsGathered;
+    if (!result.valid) {
+        stream << " reason=\"" << result.reason << "\"";
+    }
+}
+
+bool ValidateCorpus(const char *corpusName) {
+    struct CorpusMap {
+        Map *map;
+        Graph *graph;
+        SlideTable *table;
+        const char *error;
+    };
+
+    std::ifstream corpusFile;
+    corpusFile.open(corpusName);
+    if (!corpusFile.is_open()) {
+        std::cerr << "Unable to open corpus file" << std::endl;
+        std::cerr << strerror(errno) << std::endl;
+        return false;
+    }
+
+    std::map<std::string, CorpusMap> maps;
+    unsigned long long int pairs = 0, passed = 0, moves = 0;
+    auto begin = std::chrono::steady_clock::now();
+
+    std::string line, mapName, stringPath;
+    while (std::getline(corpusFile, line)) {
+        std::istringstream lineStream(line);
+        if (!(lineStream >> mapName) || mapName[0] == ';') continue;
+        if (!(lineStream >> stringPath)) stringPath.clear();
+
+        auto mkv = maps.find(mapName);
+        if (mkv == maps.end()) {
+            CorpusMap corpusMap = {nullptr, nullptr, nullptr, nullptr};
+            try {
+                corpusMap.map = ReadMapFromFile(mapName.c_str());
+                if (corpusMap.map == nullptr) {
+                    corpusMap.error = "Unable to open map";
+                } else {
+                    corpusMap.graph = new Graph(corpusMap.map);
+                    corpusMap.table = new SlideTable(corpusMap.map, corpusMap.graph);
+                }
+            } catch (const char *e) {
+                delete corpusMap.graph;
+                delete corpusMap.map;
+                corpusMap = {nullptr, nullptr, nullptr, e};
+            }
+            mkv = maps.insert(std::pair<std::string, CorpusMap>(mapName, corpusMap)).first;
+        }
+
+        pairs++;
+        std::cout << mapName << ' ' << stringPath << ' ';
+        if (mkv->second.table == nullptr) {
+            std::cout << "FAIL reason=\"" << mkv->second.error << "\"" << '\n';
+            continue;
+        }
+
+        ReplayResult result = mkv->second.table->replay(stringPath.c_str());
+        moves += result.leaps;
+        if (result.valid) passed++;
+        PrintReplayResult(result);
+        std::cout << '\n';
+    }
+    corpusFile.close();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "passed " << passed << "/" << pairs << ", " << moves << " moves in " << seconds << "s"
+              << std::endl;
+
+    for (const auto &mkv : maps) {
+        delete mkv.second.table;
+        delete mkv.second.graph;
+        delete mkv.second.map;
+    }
+    return passed == pairs;
+}
+
+unsigned long long int ParseNumber(const char *text) {
+    char *end;
+    errno = 0;
+    unsigned long long int value = strtoull(text, &end, 10);
+    if (!isdigit(text[0]) || *end != '\0' || errno == ERANGE) {
+        throw "Wrong number";
+    }
+    return value;
+}
+
+void CountSolutions(Map *map, unsigned long long int limit) {
+    auto graph = new Graph(map);
+    SlideTable table(map, graph);
+    SolutionCounter counter(&table);
+
+    std::cout << counter.count().toString() << std::endl;
+
+    SolutionEnumerator enumerator(&counter);
+    std::string solution;
+    for (unsigned long long int i = 0; i < limit && enumerator.next(solution); ++i) {
+        std::cout << solution << '\n';
+    }
+    std::cout.flush();
+    delete graph;
+}
+
+void BeamSolve(Map *map, Graph *graph) {
+    SlideTable table(map, graph);
+    BeamSearch beam(&table, BeamWidth);
+    BeamResult result = beam.run();
+
+    if (result.allDiamonds > 0 && result.diamondsGathered == result.allDiamonds) {
+        std::cout << result.path << std::endl;
+    } else {
+        std::cout << "BRAK" << std::endl;
+        std::cout << "partial " << result.path << std::endl;
+    }
+    std::cout << "gathered " << result.diamondsGathered << "/" << result.allDiamonds << std::endl;
+}
+
+void EditAndSolve(Map *map, const char *editsName) {
+    std::ifstream editsFile;
+    editsFile.open(editsName);
+    if (!editsFile.is_open()) {
+        std::cerr << "Unable to open edits file" << std::endl;
+        std::cerr << strerror(errno) << std::endl;
+        return;
+    }
+
+    auto graph = new Graph(map);
+    std::string line;
+    while (std::getline(editsFile, line)) {
+        if (line.empty()) continue;
+
+        std::istringstream lineStream(line);
+        int x, y;
+        char c = '\0';
+        if (!(lineStream >> x >> y) || lineStream.get() != ' ' || !lineStream.get(c)) {
+            std::cout << '"' << line << "\" [ERROR]: Wrong edit" << std::endl;
+            continue;
+        }
+        std::cout << x << ' ' << y << " '" << c << "' ";
+        if (c != WALL && c != HOLE && c != MINE && c != DIAX && c != VOID) {
+            std::cout << "[ERROR]: Wrong entity" << std::endl;
+            continue;
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        try {
+            graph->applyEdit(Position(x, y), (Entity) c);
+        } catch (const char *e) {
+            std::cout << "[ERROR]: " << e << std::endl;
+            continue;
+        }
+        auto result = graph->search(map->maxMoves);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        if (result->empty()) {
+            std::cout << "BRAK";
+        } else {
+            PrintPathNumbers(*result);
+        }
+        std::cout << ' ' << seconds << 's' << std::endl;
+        delete result;
+    }
+    editsFile.close();
+    delete graph;
+}
+
 void Solve(Map *map) {
     auto *graph = new Graph(map);
     if (DebugMode) {
         graph->printDot();
         graph->save("graph.dot");
+        graph->saveJsonLines("graph.jsonl");
         Stats.non_empty_nodes = graph->vertices.size();
         Stats.diamonds = graph->diamonds.size();
         for (const auto &kv : graph->vertices) {
@@ -788,7 +2285,11 @@ void Solve(Map *map) {
         }
     }
 
-    graph->traversal(map->maxMoves);
+    if (BeamWidth > 0) {
+        BeamSolve(map, graph);
+    } else {
+        graph->traversal(map->maxMoves);
+    }
     if (DebugMode) Stats.save("log.csv");
     delete graph;
 }
@@ -803,6 +2304,44 @@ Map *ReadMapFromStdin() {
 
 int main(int argc, char *argv[]) {
     try {
+        if (argc > 2 && strcmp(argv[1], "--validate") == 0) {
+            return ValidateCorpus(argv[2]) ? 0 : 1;
+        }
+
+        if (argc > 3 && strcmp(argv[1], "--edit") == 0) {
+            Map *map = ReadMapFromFile(argv[2]);
+            if (map == nullptr) return 0;
+            EditAndSolve(map, argv[3]);
+            delete map;
+            return 0;
+        }
+
+        if (argc > 2 && strcmp(argv[1], "--count") == 0) {
+            unsigned long long int limit = argc > 3 ? ParseNumber(argv[3]) : 0;
+            Map *map = ReadMapFromFile(argv[2]);
+            if (map == nullptr) return 0;
+            CountSolutions(map, limit);
+            delete map;
+            return 0;
+        }
+
+        while (argc > 1 && strncmp(argv[1], "--", 2) == 0) {
+            if (strcmp(argv[1], "--shorten") == 0) {
+                ShortenPaths = true;
+                argv++;
+                argc--;
+            } else if (strcmp(argv[1], "--beam") == 0) {
+                if (argc < 3) throw "Missing beam width";
+                unsigned long long int width = ParseNumber(argv[2]);
+                if (width == 0 || width > std::numeric_limits<int>::max()) throw "Beam width must be positive";
+                BeamWidth = (int) width;
+                argv += 2;
+                argc -= 2;
+            } else {
+                throw "Unknown option";
+            }
+        }
+
         DebugMode = argc > 1;
         Map *map = (argc > 1) ? ReadMapFromFile(argv[1]) : ReadMapFromStdin();
         if (DebugMode) {
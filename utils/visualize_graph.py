@@ -1,5 +1,32 @@
+import json
 import sys
-from graphviz import Source
+from graphviz import Digraph, Source
+
+
+def node_name(position):
+    return f'({position[0]},{position[1]})'
+
+
+def load_json_lines(graph_file_path):
+    dot = Digraph('diaminy', graph_attr={'rankdir': 'TOP'},
+                  node_attr={'style': 'filled', 'shape': 'circle', 'color': 'lightgreen'})
+
+    start = None
+    with open(graph_file_path, 'r') as jsonl_file:
+        for line in jsonl_file:
+            record = json.loads(line)
+            if record['type'] == 'graph':
+                start = record['start']
+            elif record['type'] == 'edge':
+                attributes = {'label': str(len(record['diamonds']))}
+                if record['path']:
+                    attributes.update(style='bold', color='tomato')
+                    dot.node(node_name(record['to']), color='lightskyblue')
+                dot.edge(node_name(record['from']), node_name(record['to']), **attributes)
+
+    if start is not None:
+        dot.node(node_name(start), color='gold')
+    return dot
 
 
 def main():
@@ -9,10 +36,14 @@ def main():
 
         graph_file_path = sys.argv[1]
 
-        with open(graph_file_path, 'r') as dot_file:
-            dot_content = dot_file.read()
+        if graph_file_path.endswith('.jsonl'):
+            s = load_json_lines(graph_file_path)
+            s.format = 'svg'
+        else:
+            with open(graph_file_path, 'r') as dot_file:
+                dot_content = dot_file.read()
 
-        s = Source(dot_content, format='svg')
+            s = Source(dot_content, format='svg')
         s.view()
     except Exception as e:
         print(e)